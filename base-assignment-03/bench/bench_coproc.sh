@@ -0,0 +1,38 @@
+#!/bin/sh
+# Coprocess throughput benchmark.
+# Compares items/s for spawning a filter per item against feeding the same
+# filter, kept alive with 'coproc', through coproc_send/coproc_recv.
+#
+# Usage: base-assignment-03/bench/bench_coproc.sh [coproc_items] [spawn_items]
+# (run from the repository root after 'make')
+
+COPROC_ITEMS=${1:-100000}
+SPAWN_ITEMS=${2:-1000}
+SHELL_BIN=${SHELL_BIN:-./bin/myshell}
+SCRIPT=$(mktemp /tmp/bench_coproc.XXXXXX)
+trap 'rm -f "$SCRIPT"' EXIT
+
+now_ns() { date +%s%N; }
+
+report() {
+    awk -v n="$2" -v ns="$3" -v l="$1" \
+        'BEGIN { printf "%-8s %10.0f items/s  (%d items, %.3f s)\n", l, n / (ns / 1e9), n, ns / 1e9 }'
+}
+
+# one fork+exec per item
+awk -v n="$SPAWN_ITEMS" 'BEGIN { for (i = 0; i < n; i++) printf "echo item%d | cat\n", i }' > "$SCRIPT"
+t0=$(now_ns)
+"$SHELL_BIN" < "$SCRIPT" > /dev/null 2>&1
+t1=$(now_ns)
+report spawn "$SPAWN_ITEMS" $((t1 - t0))
+
+# one long-lived worker
+awk -v n="$COPROC_ITEMS" 'BEGIN {
+    print "coproc W cat"
+    for (i = 0; i < n; i++) printf "coproc_send W item%d\ncoproc_recv W R\n", i
+    print "coproc_close W"
+}' > "$SCRIPT"
+t0=$(now_ns)
+"$SHELL_BIN" < "$SCRIPT" > /dev/null 2>&1
+t1=$(now_ns)
+report coproc "$COPROC_ITEMS" $((t1 - t0))
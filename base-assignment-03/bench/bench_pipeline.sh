@@ -0,0 +1,44 @@
+#!/bin/sh
+# Pipeline placement benchmark.
+# Runs a multi-stage byte-crunching pipeline through myshell with no pinning,
+# pin=pack and pin=spread and reports throughput in MB/s.
+#
+# Usage: base-assignment-03/bench/bench_pipeline.sh [size_mb] [rounds]
+# (run from the repository root after 'make')
+
+SIZE_MB=${1:-256}
+ROUNDS=${2:-3}
+SHELL_BIN=${SHELL_BIN:-./bin/myshell}
+DATA=$(mktemp /tmp/bench_pipeline.XXXXXX)
+trap 'rm -f "$DATA"' EXIT
+
+head -c $((SIZE_MB * 3 / 4 * 1024 * 1024)) /dev/urandom | base64 -w 0 > "$DATA"
+BYTES=$(wc -c < "$DATA")
+PIPELINE="cat $DATA | tr a-z n-za-m | tr A-Z a-z | tr -d 0-9 | cksum"
+
+now_ns() { date +%s%N; }
+
+run() {
+    label=$1
+    prefix=$2
+    best=0
+    i=0
+    while [ $i -lt "$ROUNDS" ]; do
+        t0=$(now_ns)
+        echo "$prefix $PIPELINE" | "$SHELL_BIN" > /dev/null 2>&1
+        t1=$(now_ns)
+        dt=$((t1 - t0))
+        if [ $best -eq 0 ] || [ $dt -lt $best ]; then best=$dt; fi
+        i=$((i + 1))
+    done
+    awk -v b="$BYTES" -v ns="$best" -v l="$label" \
+        'BEGIN { printf "%-8s %8.1f MB/s  (%.3f s, best of '"$ROUNDS"')\n", l, b / (ns / 1e9) / 1e6, ns / 1e9 }'
+}
+
+echo "$(nproc) CPUs, $((BYTES / 1024 / 1024)) MB input, 5-stage pipeline"
+if [ "$(nproc)" -lt 5 ]; then
+    echo "note: fewer CPUs than stages; pinned stages share CPUs, so pack/spread cannot beat none here"
+fi
+run none ""
+run pack "limit pin=pack"
+run spread "limit pin=spread"
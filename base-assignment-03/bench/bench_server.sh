@@ -0,0 +1,44 @@
+#!/bin/sh
+# Server mode benchmark: latency of one short script through
+# 'myshell-client' against a warm 'myshell --server', compared with a cold
+# 'myshell -c', plus throughput with several concurrent clients.
+#
+# Usage: base-assignment-03/bench/bench_server.sh [runs] [parallel]
+# (run from the repository root after 'make')
+
+RUNS=${1:-2000}
+PAR=${2:-8}
+SHELL_BIN=${SHELL_BIN:-./bin/myshell}
+CLIENT_BIN=${CLIENT_BIN:-./bin/myshell-client}
+SOCK=/tmp/bench_server.$$.sock
+SCRIPT='X=1; true'
+
+"$SHELL_BIN" -c 'BASE=1' --server "$SOCK" 2> /dev/null &
+SERVER=$!
+trap 'kill $SERVER 2> /dev/null; rm -f "$SOCK"' EXIT
+i=0
+while [ ! -S "$SOCK" ] && [ $i -lt 50 ]; do sleep 0.1; i=$((i + 1)); done
+
+now_ns() { date +%s%N; }
+
+latency() {
+    label=$1
+    shift
+    t0=$(now_ns)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$@" "$SCRIPT"
+        i=$((i + 1))
+    done
+    t1=$(now_ns)
+    printf "%-14s %8d us/run  (%d sequential runs)\n" "$label" $(( (t1 - t0) / RUNS / 1000 )) "$RUNS"
+}
+
+latency cold "$SHELL_BIN" -c
+latency server "$CLIENT_BIN" "$SOCK"
+
+t0=$(now_ns)
+seq "$RUNS" | xargs -P "$PAR" -I{} "$CLIENT_BIN" "$SOCK" "$SCRIPT"
+t1=$(now_ns)
+awk -v n="$RUNS" -v ns=$((t1 - t0)) -v p="$PAR" \
+    'BEGIN { printf "%-14s %8.0f req/s  (%d requests, %d clients)\n", "server", n / (ns / 1e9), n, p }'
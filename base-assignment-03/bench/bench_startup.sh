@@ -0,0 +1,30 @@
+#!/bin/sh
+# Cold-start latency benchmark: average wall time of '<shell> -c true' in
+# microseconds, for each myshell build present and for dash as the target.
+#
+# Usage: base-assignment-03/bench/bench_startup.sh [runs]
+# (run from the repository root after 'make', 'make release', 'make static')
+
+RUNS=${1:-2000}
+
+now_ns() { date +%s%N; }
+
+measure() {
+    bin=$1
+    [ -x "$bin" ] || command -v "$bin" > /dev/null 2>&1 || { printf "%-22s not built\n" "$bin"; return; }
+    "$bin" -c true || { printf "%-22s failed\n" "$bin"; return; }
+    t0=$(now_ns)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$bin" -c true
+        i=$((i + 1))
+    done
+    t1=$(now_ns)
+    printf "%-22s %8d us/run  (%d runs)\n" "$bin" $(( (t1 - t0) / RUNS / 1000 )) "$RUNS"
+}
+
+measure /bin/true
+measure dash
+measure ./bin/myshell
+measure ./bin/myshell-release
+measure ./bin/myshell-static
@@ -0,0 +1,70 @@
+/* Tokenizer throughput benchmark.
+ * Generates a large script and reports tokenize() speed in MB/s for each
+ * scanner implementation. Built with the shell's own CFLAGS ('make bench'),
+ * so the numbers match what bin/myshell does; '*' marks its default.
+ *
+ * Usage: bin/bench_tokenize [size_mb] [rounds]
+ */
+#define _GNU_SOURCE
+#include "shell.h"
+#include <time.h>
+
+static const char *sample_lines[] = {
+    "cat /var/log/syslog | grep -v 'kernel|audit' | sort -u > /tmp/filtered_output.txt",
+    "OUTDIR=\"/home/user/build output\"; echo \"building a|b;c in $OUTDIR\"",
+    "find /usr/share/doc -name changelog.Debian.gz < /dev/null | wc -l &",
+    "if_needed_compile_everything --with-optimizations --prefix=/opt/local/software",
+    "echo escaped\\ space \"quoted \\\"inner\\\" text\" plain_argument_with_long_name",
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *generate_script(size_t target) {
+    char *buf = malloc(target + 256);
+    if (!buf) return NULL;
+    size_t len = 0;
+    size_t nsamples = sizeof(sample_lines) / sizeof(sample_lines[0]);
+    for (size_t i = 0; len < target; ++i) {
+        len += (size_t)sprintf(buf + len, "%s\n", sample_lines[i % nsamples]);
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 16;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if (mb == 0 || rounds <= 0) { fprintf(stderr, "usage: %s [size_mb] [rounds]\n", argv[0]); return 1; }
+
+    char *script = generate_script(mb << 20);
+    if (!script) { perror("malloc"); return 1; }
+    size_t len = strlen(script);
+
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    for (int level = SCAN_SCALAR; level <= SCAN_AVX2; ++level) {
+        if (tokenizer_set_scan(level) != level) {
+            printf("%-7s unavailable on this CPU\n", names[level]);
+            continue;
+        }
+        double best = 1e30;
+        int ntoks = 0;
+        for (int r = 0; r < rounds; ++r) {
+            TokenList tl;
+            double t0 = now_sec();
+            if (tokenize(script, &tl) != 0) { fprintf(stderr, "tokenize failed\n"); return 1; }
+            double dt = now_sec() - t0;
+            ntoks = tl.count;
+            free_tokens(&tl);
+            if (dt < best) best = dt;
+        }
+        printf("%-7s %8.1f MB/s  (%zu bytes, %d tokens, best of %d)%s\n",
+               names[level], len / best / 1e6, len, ntoks, rounds,
+               level == tokenizer_default_scan() ? " *" : "");
+    }
+    free(script);
+    return 0;
+}
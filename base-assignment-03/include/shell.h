@@ -11,17 +11,17 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <sched.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 
 #define PROMPT "FCIT> "
-#define MAX_ARGS 64
-#define MAX_CMDS 16
 #define MAX_JOBS 128
 
 /* Command structure for pipeline parsing */
 typedef struct {
-    char *argv[MAX_ARGS];   // argv for execvp, NULL terminated
+    char **argv;            // argv for execvp, NULL terminated (heap, sized to the input)
+    int argc;               // words in argv (also set on a partial parse)
     char *input_file;       // filename for '<'
     char *output_file;      // filename for '>'
 } Command;
@@ -30,8 +30,33 @@ typedef struct {
 typedef struct {
     pid_t pid;
     char *cmdline;
+    char *cgroup;       // job cgroup directory, NULL if none
+    int leader_done;    // first stage reaped, cgroup still populated
+    int limited;        // started with a 'limit' prefix
 } Job;
 
+/* Per-job options set by the 'limit' prefix (see limits.c) */
+typedef struct {
+    int active;             // a 'limit' prefix was given
+    long cpu_seconds;       // RLIMIT_CPU, -1 if unset
+    long long as_bytes;     // RLIMIT_AS, -1 if unset
+    long nofile;            // RLIMIT_NOFILE, -1 if unset
+    long long mem_bytes;    // cgroup memory.max (RLIMIT_AS fallback), -1 if unset
+    double cpus;            // cgroup cpu.max in CPUs, 0 if unset
+    int has_cpuset;
+    cpu_set_t cpuset;       // affinity for every stage
+    int pin;                // PIN_* per-stage placement policy
+    int has_nice;
+    int nice;
+    int ioprio;             // ioprio_set() value, -1 if unset
+    int stdin_fd;           // first stage stdin (coproc), -1 = inherit
+    int stdout_fd;          // last stage stdout (coproc), -1 = inherit
+} JobOptions;
+
+#define PIN_NONE   0
+#define PIN_PACK   1    // adjacent stages on sibling cores
+#define PIN_SPREAD 2    // stages as far apart as possible
+
 /* Variable linked list node */
 typedef struct VarNode {
     char *name;
@@ -39,34 +64,116 @@ typedef struct VarNode {
     struct VarNode *next;
 } VarNode;
 
+/* Token produced by tokenize() */
+typedef enum {
+    TOK_WORD,       // ordinary word (quotes removed)
+    TOK_ASSIGN,     // NAME=value in command position
+    TOK_PIPE,       // |
+    TOK_SEMI,       // ; or newline
+    TOK_AMP,        // &
+    TOK_REDIR_IN,   // <
+    TOK_REDIR_OUT   // >
+} TokenType;
+
+#define TOKF_NOEXPAND 0x1   // word began with quoted/escaped text: no $VAR expansion
+
+typedef struct {
+    TokenType type;
+    int flags;
+    char *text;     // word text for TOK_WORD/TOK_ASSIGN, NULL for operators
+    size_t start;   // byte range of the token in the source line
+    size_t end;
+} Token;
+
+typedef struct {
+    Token *toks;
+    int count;
+    int cap;
+    char *buf;      // backing storage for all token texts
+} TokenList;
+
+/* Scanner implementations for tokenizer_set_scan() */
+#define SCAN_SCALAR 0
+#define SCAN_SSE2   1
+#define SCAN_AVX2   2
+
+/* Tokenizer */
+int tokenize(const char *line, TokenList *tl);   // 0 on success, -1 on error
+void free_tokens(TokenList *tl);
+int tokenizer_set_scan(int level);               // returns the level actually selected
+int tokenizer_default_scan(void);                // level tokenize() picks (scalar unless optimised)
+
 /* Parsing and memory */
-int parse_pipeline(char *line, Command *cmds, int *num_cmds);
-void free_commands(Command *cmds, int num_cmds);
+/* parse_pipeline: builds a heap Command[] (*cmds) from a token slice holding one
+ * statement (no TOK_SEMI/TOK_AMP). Unquoted $VAR words are expanded here.
+ * On error *cmds may still be set; always release it with free_commands(). */
+int parse_pipeline(const Token *toks, int ntoks, Command **cmds, int *num_cmds);
+void free_commands(Command *cmds, int num_cmds);   // frees the array too
 char *trim(char *s);
 
 /* Execution */
 /* execute_pipeline:
  *  - if background == 0: returns exit code (0..255) of pipeline, or -1 on parse/exec error.
  *  - if background == 1: registers background job and returns 0 on success or -1 on error.
+ *  - opts may be NULL (no limits).
  */
-int execute_pipeline(Command *cmds, int num_cmds, int background, const char *orig_cmdline);
+int execute_pipeline(Command *cmds, int num_cmds, int background, const char *orig_cmdline,
+                     const JobOptions *opts);
+
+/* Job limits (limits.c) */
+void job_options_init(JobOptions *o);
+int parse_job_options(const Token *toks, int ntoks, JobOptions *o);  // tokens consumed, or -1
+char *job_cgroup_create(const JobOptions *o);        // malloc'd path, NULL = rlimits only
+int job_cgroup_remove(const char *cgroup);           // 0 when removed, -1 while populated
+void job_apply_limits(const JobOptions *o, const char *cgroup);   // in the child
+void print_job_usage(const char *cgroup, int limited);
+
+/* Stage placement (placement.c) */
+int parse_cpu_list(const char *s, cpu_set_t *set);  // 0 on success
+int parse_ioprio(const char *s);                     // ioprio value, -1 on error
+int *placement_order(const JobOptions *o, int *n);   // malloc'd CPU order, NULL = no pinning
+int placement_cpu(const JobOptions *o, const int *order, int n, int stage, int nstages);
+void job_apply_placement(const JobOptions *o, int cpu);   // in the child; cpu -1 = job cpuset
+
+/* Coprocesses (coproc.c) */
+int coproc_prepare(const char *name, JobOptions *opts);   // pipes -> opts->stdin_fd/stdout_fd
+int coproc_commit(const char *name, JobOptions *opts, int started);
+int handle_coproc_builtin(char **arglist, int *status);
+
+/* Script runner (main.c) */
+int run_script_string(const char *script);   // exit status of the last command
+
+/* Server mode (server.c): 'myshell --server SOCK'.
+ * Request: ServerRequest header carrying 3 fds (stdin, stdout, stderr) via
+ * SCM_RIGHTS, followed by script_len bytes of script.
+ * Reply: one int32 exit status.
+ */
+#define SERVER_MAGIC 0x6d797368u    // "mysh"
+#define SERVER_MAX_SCRIPT (16u << 20)
+#define SERVER_MAX_WORKERS 64
+
+typedef struct {
+    unsigned int magic;
+    unsigned int script_len;
+} ServerRequest;
+
+int run_server(const char *path);
 
 /* Builtins */
 int handle_builtin_status(char **arglist, int *status);
+int is_builtin(const char *name);
 
 /* Job management */
-int add_job(pid_t pid, const char *cmdline);
+int add_job(pid_t pid, const char *cmdline, const char *cgroup, int limited);
 int remove_job_by_pid(pid_t pid);
-void print_jobs(void);
+void print_jobs(int verbose);
 void reap_jobs(void);
 
 /* Variables API */
 int set_variable(const char *name, const char *value);   // returns 0 on success
 const char *get_variable(const char *name);              // returns NULL if not found
+int unset_variable(const char *name);                    // returns -1 if not found
 void print_variables(void);
 void free_all_variables(void);
 
-/* Utility for expansion: expand variables in argv lists (in-place replacement) */
-int expand_vars_in_commands(Command *cmds, int num_cmds);
-
 #endif // SHELL_H
@@ -0,0 +1,97 @@
+#define _GNU_SOURCE
+#include "shell.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* ----------------- myshell-client -----------------
+ * Sends a script to 'myshell --server SOCK' together with this process's
+ * stdin/stdout/stderr, waits for it to finish and exits with its status.
+ *
+ * Usage: myshell-client SOCK 'script'
+ *        myshell-client SOCK -f FILE
+ */
+
+static char *read_file_all(const char *path, size_t *len) {
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return NULL; }
+    size_t cap = 4096, n = 0;
+    char *buf = malloc(cap);
+    size_t r;
+    while (buf && (r = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += r;
+        if (n == cap) {
+            char *nb = realloc(buf, cap *= 2);
+            if (!nb) { free(buf); buf = NULL; }
+            buf = nb;
+        }
+    }
+    fclose(f);
+    *len = n;
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[2], "-f") == 0 && argc < 4)) {
+        fprintf(stderr, "usage: %s SOCK 'script' | %s SOCK -f FILE\n", argv[0], argv[0]);
+        return 2;
+    }
+    size_t len;
+    char *script;
+    if (strcmp(argv[2], "-f") == 0) {
+        script = read_file_all(argv[3], &len);
+        if (!script) return 2;
+    } else {
+        script = argv[2];
+        len = strlen(script);
+    }
+    if (len > SERVER_MAX_SCRIPT) { fprintf(stderr, "%s: script too large\n", argv[0]); return 2; }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(argv[1]) >= sizeof(addr.sun_path)) { fprintf(stderr, "%s: socket path too long\n", argv[0]); return 2; }
+    strcpy(addr.sun_path, argv[1]);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    /* header + our three stdio fds in one message, then the script */
+    ServerRequest req = { SERVER_MAGIC, (unsigned int)len };
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    char cbuf[CMSG_SPACE(sizeof(fds))];
+    memset(cbuf, 0, sizeof(cbuf));
+    struct iovec iov = { .iov_base = &req, .iov_len = sizeof(req) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(req)) { perror("sendmsg"); return 2; }
+    for (size_t off = 0; off < len; ) {
+        ssize_t w = send(fd, script + off, len - off, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            perror("send");
+            return 2;
+        }
+        off += (size_t)w;
+    }
+
+    int status;
+    size_t got = 0;
+    while (got < sizeof(status)) {
+        ssize_t r = read(fd, (char *)&status + got, sizeof(status) - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) { fprintf(stderr, "%s: server closed connection\n", argv[0]); return 2; }
+        got += (size_t)r;
+    }
+    close(fd);
+    return status & 0xFF;
+}
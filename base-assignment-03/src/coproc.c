@@ -0,0 +1,225 @@
+#define _GNU_SOURCE
+#include "shell.h"
+#include <signal.h>
+
+/* ----------------- Coprocesses -----------------
+ * 'coproc NAME cmd ...' starts cmd as a background job whose stdin and
+ * stdout are pipes held by the shell. The worker stays alive, so a loop can
+ * talk to it with builtins instead of forking a filter per item:
+ *   coproc_send NAME words...   write one line to the worker
+ *   coproc_recv NAME [VAR]      read one reply line into VAR (or print it)
+ *   coproc_close NAME           close both pipes (worker sees EOF)
+ * Variables NAME_PID, NAME_IN (fd we write) and NAME_OUT (fd we read) are set
+ * until coproc_close. The fds are informational only: they are close-on-exec
+ * (otherwise every later child, the worker included, would hold the pipes
+ * open), so only the builtins above can use them.
+ * Workers must flush per line (awk: fflush(), python: -u).
+ */
+
+#define COPROC_RBUF 65536
+
+typedef struct {
+    char *name;
+    int to_fd;          // shell -> worker stdin
+    int from_fd;        // worker stdout -> shell
+    char *rbuf;         // buffered replies
+    size_t rpos, rlen;
+} Coproc;
+
+static Coproc *coprocs = NULL;
+static int coprocs_count = 0;
+static int coprocs_cap = 0;
+
+/* pending start: the child ends live in JobOptions until coproc_commit() */
+static Coproc pending;
+
+static Coproc *find_coproc(const char *name) {
+    for (int i = 0; i < coprocs_count; ++i)
+        if (strcmp(coprocs[i].name, name) == 0) return &coprocs[i];
+    return NULL;
+}
+
+static void set_int_variable(const char *name, const char *suffix, long v) {
+    char var[160], val[32];
+    snprintf(var, sizeof(var), "%s_%s", name, suffix);
+    snprintf(val, sizeof(val), "%ld", v);
+    set_variable(var, val);
+}
+
+static void unset_coproc_variables(const char *name) {
+    static const char *suffixes[] = { "PID", "IN", "OUT" };
+    char var[160];
+    for (int i = 0; i < 3; ++i) {
+        snprintf(var, sizeof(var), "%s_%s", name, suffixes[i]);
+        unset_variable(var);
+    }
+}
+
+/* Create both pipes and point opts->stdin_fd/stdout_fd at the worker ends.
+ * Returns 0 on success, -1 on error.
+ */
+int coproc_prepare(const char *name, JobOptions *opts) {
+    if (find_coproc(name)) { fprintf(stderr, "coproc: %s already running\n", name); return -1; }
+    if (coprocs_count == coprocs_cap) {
+        int ncap = coprocs_cap ? coprocs_cap * 2 : 4;
+        Coproc *nc = realloc(coprocs, ncap * sizeof(Coproc));
+        if (!nc) { perror("coproc: realloc"); return -1; }
+        coprocs = nc;
+        coprocs_cap = ncap;
+    }
+
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0) { perror("coproc: pipe"); return -1; }
+    if (pipe2(out, O_CLOEXEC) < 0) { perror("coproc: pipe"); close(in[0]); close(in[1]); return -1; }
+
+    /* a worker that exits must not kill the shell on the next send */
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&pending, 0, sizeof(pending));
+    pending.to_fd = in[1];
+    pending.from_fd = out[0];
+    opts->stdin_fd = in[0];
+    opts->stdout_fd = out[1];
+    return 0;
+}
+
+/* Finish coproc_prepare() after execute_pipeline(): close the worker ends
+ * in the shell and register the coprocess if the start succeeded.
+ */
+int coproc_commit(const char *name, JobOptions *opts, int started) {
+    close(opts->stdin_fd);
+    close(opts->stdout_fd);
+    opts->stdin_fd = opts->stdout_fd = -1;
+
+    if (!started) {
+        close(pending.to_fd);
+        close(pending.from_fd);
+        return -1;
+    }
+    Coproc *c = &coprocs[coprocs_count];
+    *c = pending;
+    c->name = strdup(name);
+    c->rbuf = malloc(COPROC_RBUF);
+    if (!c->name || !c->rbuf) {
+        free(c->name);
+        free(c->rbuf);
+        close(c->to_fd);
+        close(c->from_fd);
+        return -1;
+    }
+    coprocs_count++;
+
+    const char *pid = get_variable("!");
+    set_int_variable(name, "PID", pid ? atol(pid) : -1);
+    set_int_variable(name, "IN", c->to_fd);
+    set_int_variable(name, "OUT", c->from_fd);
+    return 0;
+}
+
+/* ----------------- Builtins ----------------- */
+static int coproc_send(char **argv) {
+    if (!argv[1]) { fprintf(stderr, "coproc_send: usage: coproc_send NAME [words...]\n"); return 2; }
+    Coproc *c = find_coproc(argv[1]);
+    if (!c) { fprintf(stderr, "coproc_send: no coprocess '%s'\n", argv[1]); return 1; }
+
+    /* one write per request: join words into a single line */
+    size_t len = 1;
+    for (int i = 2; argv[i]; ++i) len += strlen(argv[i]) + 1;
+    char stackbuf[1024];
+    char *line = len <= sizeof(stackbuf) ? stackbuf : malloc(len);
+    if (!line) { perror("coproc_send"); return 1; }
+    size_t pos = 0;
+    for (int i = 2; argv[i]; ++i) {
+        if (i > 2) line[pos++] = ' ';
+        size_t l = strlen(argv[i]);
+        memcpy(line + pos, argv[i], l);
+        pos += l;
+    }
+    line[pos++] = '\n';
+
+    int rc = 0;
+    for (size_t off = 0; off < pos; ) {
+        ssize_t w = write(c->to_fd, line + off, pos - off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            perror("coproc_send");
+            rc = 1;
+            break;
+        }
+        off += (size_t)w;
+    }
+    if (line != stackbuf) free(line);
+    return rc;
+}
+
+/* Next reply line without its newline; NULL on EOF/error. Valid until the
+ * next call. */
+static char *read_reply(Coproc *c) {
+    for (;;) {
+        char *nl = memchr(c->rbuf + c->rpos, '\n', c->rlen - c->rpos);
+        if (nl) {
+            char *line = c->rbuf + c->rpos;
+            *nl = '\0';
+            c->rpos = (size_t)(nl - c->rbuf) + 1;
+            return line;
+        }
+        /* compact, then refill */
+        if (c->rpos > 0) {
+            memmove(c->rbuf, c->rbuf + c->rpos, c->rlen - c->rpos);
+            c->rlen -= c->rpos;
+            c->rpos = 0;
+        }
+        if (c->rlen == COPROC_RBUF - 1) {   /* over-long line: return what we have */
+            c->rbuf[c->rlen] = '\0';
+            c->rlen = 0;
+            return c->rbuf;
+        }
+        ssize_t r = read(c->from_fd, c->rbuf + c->rlen, COPROC_RBUF - 1 - c->rlen);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            if (c->rlen == 0) return NULL;
+            c->rbuf[c->rlen] = '\0';   /* last line without newline */
+            c->rlen = 0;
+            return c->rbuf;
+        }
+        c->rlen += (size_t)r;
+    }
+}
+
+static int coproc_recv(char **argv) {
+    if (!argv[1]) { fprintf(stderr, "coproc_recv: usage: coproc_recv NAME [VAR]\n"); return 2; }
+    Coproc *c = find_coproc(argv[1]);
+    if (!c) { fprintf(stderr, "coproc_recv: no coprocess '%s'\n", argv[1]); return 1; }
+
+    char *line = read_reply(c);
+    if (!line) return 1;
+    if (argv[2]) set_variable(argv[2], line);
+    else printf("%s\n", line);
+    return 0;
+}
+
+static int coproc_close(char **argv) {
+    if (!argv[1]) { fprintf(stderr, "coproc_close: usage: coproc_close NAME\n"); return 2; }
+    for (int i = 0; i < coprocs_count; ++i) {
+        if (strcmp(coprocs[i].name, argv[1]) != 0) continue;
+        close(coprocs[i].to_fd);
+        close(coprocs[i].from_fd);
+        unset_coproc_variables(coprocs[i].name);
+        free(coprocs[i].name);
+        free(coprocs[i].rbuf);
+        for (int j = i; j < coprocs_count - 1; ++j) coprocs[j] = coprocs[j + 1];
+        coprocs_count--;
+        return 0;
+    }
+    fprintf(stderr, "coproc_close: no coprocess '%s'\n", argv[1]);
+    return 1;
+}
+
+/* If arglist is a coproc builtin, run it, set *status and return 1. */
+int handle_coproc_builtin(char **arglist, int *status) {
+    if (strcmp(arglist[0], "coproc_send") == 0) *status = coproc_send(arglist);
+    else if (strcmp(arglist[0], "coproc_recv") == 0) *status = coproc_recv(arglist);
+    else if (strcmp(arglist[0], "coproc_close") == 0) *status = coproc_close(arglist);
+    else return 0;
+    return 1;
+}
@@ -0,0 +1,320 @@
+#define _GNU_SOURCE
+#include "shell.h"
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+/* ----------------- Per-job limits -----------------
+ * 'limit key=value ... cmd' applies rlimits to every stage of the pipeline.
+ * When a writable cgroup v2 hierarchy with the memory and cpu controllers is
+ * available, the job also gets its own cgroup (memory.max, cpu.max) which
+ * 'jobs -v' reads for live usage. Otherwise mem= falls back to RLIMIT_AS.
+ * Placement keys (cpuset=, pin=, nice=, ioprio=) are handled in placement.c.
+ *
+ * Environment:
+ *   MYSHELL_CGROUP=0          never use cgroups (rlimits only)
+ *   MYSHELL_CGROUP_ROOT=DIR   create job cgroups under DIR (a delegated
+ *                             cgroup) instead of the shell's own cgroup
+ */
+
+#define CPU_PERIOD_US 100000
+
+static int cg_state = -1;          /* -1 not probed, 0 unavailable, 1 usable */
+static char cg_base[PATH_MAX - 64];   /* room for the job directory name */
+static unsigned cg_seq = 0;
+
+void job_options_init(JobOptions *o) {
+    memset(o, 0, sizeof(*o));
+    o->cpu_seconds = -1;
+    o->as_bytes = -1;
+    o->nofile = -1;
+    o->mem_bytes = -1;
+    o->ioprio = -1;
+    o->stdin_fd = -1;
+    o->stdout_fd = -1;
+}
+
+/* ----------------- Option parsing ----------------- */
+/* "512", "64K", "256M", "2G" (powers of 1024). Returns -1 on error. */
+static long long parse_size(const char *s) {
+    char *end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (errno || end == s || v < 0) return -1;
+    switch (toupper((unsigned char)*end)) {
+    case '\0': return v;
+    case 'K': v <<= 10; break;
+    case 'M': v <<= 20; break;
+    case 'G': v <<= 30; break;
+    case 'T': v <<= 40; break;
+    default: return -1;
+    }
+    return end[1] == '\0' ? v : -1;
+}
+
+static long parse_count(const char *s) {
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (errno || end == s || *end != '\0' || v < 0) return -1;
+    return v;
+}
+
+/* parse_job_options: recognise a leading 'limit key=value ... [--]' prefix.
+ * Returns the number of tokens consumed (0 when there is no prefix), or -1
+ * on error. The command itself must follow the options.
+ */
+int parse_job_options(const Token *toks, int ntoks, JobOptions *o) {
+    if (ntoks <= 0 || toks[0].type != TOK_WORD || strcmp(toks[0].text, "limit") != 0) return 0;
+
+    int i = 1;
+    for (; i < ntoks && toks[i].type == TOK_WORD; ++i) {
+        const char *w = toks[i].text;
+        if (strcmp(w, "--") == 0) { i++; break; }
+        const char *eq = strchr(w, '=');
+        if (!eq) break;   /* first plain word starts the command */
+        size_t klen = eq - w;
+        const char *val = eq + 1;
+        int bad = 0;
+        if (klen == 3 && strncmp(w, "cpu", 3) == 0) {
+            bad = (o->cpu_seconds = parse_count(val)) < 0;
+        } else if (klen == 2 && strncmp(w, "as", 2) == 0) {
+            bad = (o->as_bytes = parse_size(val)) < 0;
+        } else if (klen == 5 && strncmp(w, "files", 5) == 0) {
+            bad = (o->nofile = parse_count(val)) < 0;
+        } else if (klen == 3 && strncmp(w, "mem", 3) == 0) {
+            bad = (o->mem_bytes = parse_size(val)) < 0;
+        } else if (klen == 4 && strncmp(w, "cpus", 4) == 0) {
+            char *end;
+            o->cpus = strtod(val, &end);
+            bad = (end == val || *end != '\0' || o->cpus <= 0);
+        } else if (klen == 6 && strncmp(w, "cpuset", 6) == 0) {
+            bad = parse_cpu_list(val, &o->cpuset) < 0;
+            o->has_cpuset = !bad;
+        } else if (klen == 3 && strncmp(w, "pin", 3) == 0) {
+            if (strcmp(val, "pack") == 0) o->pin = PIN_PACK;
+            else if (strcmp(val, "spread") == 0) o->pin = PIN_SPREAD;
+            else if (strcmp(val, "none") == 0) o->pin = PIN_NONE;
+            else bad = 1;
+        } else if (klen == 4 && strncmp(w, "nice", 4) == 0) {
+            char *end;
+            o->nice = (int)strtol(val, &end, 10);
+            bad = (end == val || *end != '\0' || o->nice < -20 || o->nice > 19);
+            o->has_nice = !bad;
+        } else if (klen == 6 && strncmp(w, "ioprio", 6) == 0) {
+            bad = (o->ioprio = parse_ioprio(val)) < 0;
+        } else {
+            fprintf(stderr, "limit: unknown option '%.*s'\n", (int)klen, w);
+            return -1;
+        }
+        if (bad) {
+            fprintf(stderr, "limit: invalid value '%s'\n", w);
+            return -1;
+        }
+    }
+    if (i >= ntoks || toks[i].type != TOK_WORD) {
+        fprintf(stderr, "limit: missing command\n");
+        return -1;
+    }
+    o->active = 1;
+    return i;
+}
+
+/* ----------------- cgroup v2 helpers ----------------- */
+static int write_file(const char *dir, const char *file, const char *val) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t w = write(fd, val, strlen(val));
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return w < 0 ? -1 : 0;
+}
+
+static int read_file(const char *dir, const char *file, char *buf, size_t len) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t r = read(fd, buf, len - 1);
+    close(fd);
+    if (r < 0) return -1;
+    buf[r] = '\0';
+    while (r > 0 && isspace((unsigned char)buf[r - 1])) buf[--r] = '\0';
+    return 0;
+}
+
+/* true if 'word' appears as a whitespace separated word in 'list' */
+static int has_word(const char *list, const char *word) {
+    size_t n = strlen(word);
+    for (const char *p = list; (p = strstr(p, word)) != NULL; p += n) {
+        if ((p == list || isspace((unsigned char)p[-1])) && (p[n] == '\0' || isspace((unsigned char)p[n])))
+            return 1;
+    }
+    return 0;
+}
+
+/* Mount point of the cgroup2 hierarchy (works on unified and hybrid hosts) */
+static int find_cgroup2_mount(char *buf, size_t len) {
+    FILE *f = fopen("/proc/self/mountinfo", "r");
+    if (!f) return -1;
+    char line[1024];
+    int found = -1;
+    while (fgets(line, sizeof(line), f)) {
+        char *sep = strstr(line, " - ");
+        if (!sep || strncmp(sep + 3, "cgroup2 ", 8) != 0) continue;
+        char mnt[PATH_MAX];
+        if (sscanf(line, "%*s %*s %*s %*s %4095s", mnt) == 1) {
+            snprintf(buf, len, "%s", mnt);
+            found = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+/* Path of this process inside the cgroup2 hierarchy ("0::/path") */
+static int own_cgroup(char *buf, size_t len) {
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (!f) return -1;
+    char line[1024];
+    int found = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "0::", 3) != 0) continue;
+        line[strcspn(line, "\n")] = '\0';
+        snprintf(buf, len, "%s", strcmp(line + 3, "/") == 0 ? "" : line + 3);
+        found = 0;
+        break;
+    }
+    fclose(f);
+    return found;
+}
+
+/* Probe once: is there a writable cgroup where we can enable memory+cpu? */
+static int cgroup_init(void) {
+    if (cg_state >= 0) return cg_state;
+    cg_state = 0;
+
+    const char *env = getenv("MYSHELL_CGROUP");
+    if (env && strcmp(env, "0") == 0) return 0;
+
+    const char *root = getenv("MYSHELL_CGROUP_ROOT");
+    if (root && *root) {
+        if (snprintf(cg_base, sizeof(cg_base), "%s", root) >= (int)sizeof(cg_base)) return 0;
+    } else {
+        char mnt[PATH_MAX], own[PATH_MAX];
+        if (find_cgroup2_mount(mnt, sizeof(mnt)) < 0 || own_cgroup(own, sizeof(own)) < 0) return 0;
+        if (snprintf(cg_base, sizeof(cg_base), "%s%s", mnt, own) >= (int)sizeof(cg_base)) return 0;
+    }
+    if (access(cg_base, W_OK) != 0) return 0;
+
+    char buf[512];
+    if (read_file(cg_base, "cgroup.controllers", buf, sizeof(buf)) < 0 ||
+        !has_word(buf, "memory") || !has_word(buf, "cpu"))
+        return 0;
+    if (read_file(cg_base, "cgroup.subtree_control", buf, sizeof(buf)) == 0 &&
+        has_word(buf, "memory") && has_word(buf, "cpu")) {
+        cg_state = 1;
+        return 1;
+    }
+    /* EBUSY means processes (e.g. this shell) live in cg_base itself. We
+     * never move the shell to make room: use MYSHELL_CGROUP_ROOT instead. */
+    if (write_file(cg_base, "cgroup.subtree_control", "+memory +cpu") < 0) return 0;
+    cg_state = 1;
+    return 1;
+}
+
+/* Create the cgroup for one job. Returns a malloc'd path, or NULL when the
+ * job has to make do with rlimits only.
+ */
+char *job_cgroup_create(const JobOptions *o) {
+    if (!o || !o->active || !cgroup_init()) return NULL;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/myshell-%d-job%u", cg_base, (int)getpid(), ++cg_seq);
+    if (mkdir(path, 0755) < 0) { perror("limit: mkdir cgroup"); return NULL; }
+
+    char val[64];
+    if (o->mem_bytes >= 0) {
+        snprintf(val, sizeof(val), "%lld", o->mem_bytes);
+        if (write_file(path, "memory.max", val) < 0) goto fail;
+    }
+    if (o->cpus > 0) {
+        snprintf(val, sizeof(val), "%ld %d", (long)(o->cpus * CPU_PERIOD_US), CPU_PERIOD_US);
+        if (write_file(path, "cpu.max", val) < 0) goto fail;
+    }
+    return strdup(path);
+
+fail:
+    perror("limit: cgroup");
+    rmdir(path);
+    return NULL;
+}
+
+/* rmdir the job cgroup. Returns 0 when gone, -1 while still populated. */
+int job_cgroup_remove(const char *cgroup) {
+    if (!cgroup) return 0;
+    if (rmdir(cgroup) == 0 || errno == ENOENT) return 0;
+    return -1;
+}
+
+/* ----------------- Applying limits (in the child) ----------------- */
+static void set_limit(int resource, long long value, const char *name) {
+    struct rlimit rl;
+    rl.rlim_cur = rl.rlim_max = (rlim_t)value;
+    if (setrlimit(resource, &rl) < 0) {
+        fprintf(stderr, "limit: %s: %s\n", name, strerror(errno));
+        exit(1);
+    }
+}
+
+/* Called in each forked pipeline stage before exec. */
+void job_apply_limits(const JobOptions *o, const char *cgroup) {
+    if (!o || !o->active) return;
+    if (cgroup && write_file(cgroup, "cgroup.procs", "0") < 0) {
+        perror("limit: join cgroup");
+        exit(1);
+    }
+    long long as = o->as_bytes;
+    if (as < 0 && !cgroup) as = o->mem_bytes;   /* no memory.max: cap address space instead */
+    if (o->cpu_seconds >= 0) set_limit(RLIMIT_CPU, o->cpu_seconds, "cpu");
+    if (as >= 0) set_limit(RLIMIT_AS, as, "as");
+    if (o->nofile >= 0) set_limit(RLIMIT_NOFILE, o->nofile, "files");
+}
+
+/* ----------------- Live usage for 'jobs -v' ----------------- */
+static void format_size(long long bytes, char *buf, size_t len) {
+    const char *units = "BKMGT";
+    double v = (double)bytes;
+    int u = 0;
+    while (v >= 1024 && u < 4) { v /= 1024; u++; }
+    if (u == 0) snprintf(buf, len, "%lldB", bytes);
+    else snprintf(buf, len, "%.1f%c", v, units[u]);
+}
+
+/* 'limited' is 0 for jobs started without a 'limit' prefix */
+void print_job_usage(const char *cgroup, int limited) {
+    if (!limited) { printf("      no limits\n"); return; }
+    if (!cgroup) { printf("      rlimits only (no cgroup accounting)\n"); return; }
+
+    char cur[64] = "?", max[64] = "?", cpumax[64] = "?", stat[1024];
+    char val[64];
+    if (read_file(cgroup, "memory.current", val, sizeof(val)) == 0) format_size(atoll(val), cur, sizeof(cur));
+    if (read_file(cgroup, "memory.max", val, sizeof(val)) == 0) {
+        if (strcmp(val, "max") == 0) snprintf(max, sizeof(max), "max");
+        else format_size(atoll(val), max, sizeof(max));
+    }
+    read_file(cgroup, "cpu.max", cpumax, sizeof(cpumax));
+
+    double cpu_s = -1;
+    if (read_file(cgroup, "cpu.stat", stat, sizeof(stat)) == 0) {
+        char *p = strstr(stat, "usage_usec ");
+        if (p) cpu_s = atoll(p + 11) / 1e6;
+    }
+    printf("      cgroup %s\n", cgroup);
+    if (cpu_s >= 0) printf("      mem %s / %s   cpu %.2fs (cpu.max %s)\n", cur, max, cpu_s, cpumax);
+    else printf("      mem %s / %s   cpu ? (cpu.max %s)\n", cur, max, cpumax);
+}
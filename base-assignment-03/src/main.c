@@ -3,7 +3,8 @@
 
 /* completion list for readline */
 const char* builtin_commands[] = {
-    "cd", "exit", "help", "jobs", "history", "set", NULL
+    "cd", "exit", "help", "jobs", "history", "set", "limit",
+    "coproc", "coproc_send", "coproc_recv", "coproc_close", NULL
 };
 
 static char* command_generator(const char* text, int state) {
@@ -22,113 +23,167 @@ static char** my_completion(const char* text, int start, int end) {
     return NULL;
 }
 
-/* Helper: run a single statement (may contain pipes/redirs) or assignment.
- * Returns exit status or -1 on error.
- * Assignments (VARNAME=VALUE with no spaces around '=') are handled here as builtin and return 0.
+/* ----------------- Input -----------------
+ * Interactive sessions read through readline, which (with history and
+ * completion) is set up on the first prompt only. Scripts on stdin and -c
+ * strings never touch readline, which keeps 'myshell -c ...' startup cheap.
+ * A script on stdin is read without consuming anything past the current
+ * line, so commands that read stdin see the rest of the script (as in sh).
  */
-static int run_statement_return_status(char *stmt) {
-    if (!stmt) return -1;
-    char *s = trim(stmt);
-    if (s[0] == '\0') return 0;
-
-    // detect variable assignment: single token containing '=' and no spaces around =
-    // we check first token only: assignments are of form NAME=value (no spaces)
-    char *first_space = strpbrk(s, " \t");
-    int is_assignment = 0;
-    if (first_space == NULL) {
-        // whole line is a single token; if contains '=' then assignment
-        if (strchr(s, '=') != NULL) is_assignment = 1;
-    } else {
-        // there's a space — check the first token only
-        size_t toklen = first_space - s;
-        char tokbuf[256];
-        if (toklen < sizeof(tokbuf)) {
-            strncpy(tokbuf, s, toklen);
-            tokbuf[toklen] = '\0';
-            if (strchr(tokbuf, '=') != NULL) {
-                // ensure '=' is not at start or end of token
-                char *eq = strchr(tokbuf, '=');
-                if (eq != NULL && (eq != tokbuf) && (*(eq + 1) != '\0')) {
-                    is_assignment = 1;
-                }
-            }
-        }
-    }
+static int interactive = 0;
+static int readline_ready = 0;
+static const char *cmd_string = NULL;   // -c argument, consumed line by line
 
-    if (is_assignment) {
-        // parse name and value from first token
-        char *eq = strchr(s, '=');
-        if (!eq) return -1;
-        size_t namelen = eq - s;
-        if (namelen == 0 || namelen >= 128) {
-            fprintf(stderr, "Invalid variable name\n");
-            return -1;
+static void init_readline(void) {
+    rl_attempted_completion_function = my_completion;
+    using_history();
+    readline_ready = 1;
+}
+
+#define STDIN_BLOCK 4096
+
+/* Next line of a non-interactive stdin (malloc'd, no newline), NULL at EOF.
+ * Seekable input is read a block at a time and the offset is moved back to
+ * just after the newline; pipes are read a byte at a time, since there is
+ * no way to hand read-ahead back to the commands we run.
+ */
+static char *read_stdin_line(void) {
+    static int seekable = -1;
+    if (seekable < 0) seekable = lseek(STDIN_FILENO, 0, SEEK_CUR) >= 0;
+
+    size_t cap = STDIN_BLOCK + 1, len = 0;
+    char *line = malloc(cap);
+    if (!line) return NULL;
+    for (;;) {
+        size_t want = seekable ? STDIN_BLOCK : 1;
+        if (len + want + 1 > cap) {
+            char *nl = realloc(line, cap = (len + want + 1) * 2);
+            if (!nl) { free(line); return NULL; }
+            line = nl;
         }
-        char name[128];
-        strncpy(name, s, namelen);
-        name[namelen] = '\0';
-        // value is rest after '=' (may include quotes)
-        char *value = eq + 1;
-        // remove surrounding quotes if present
-        char *val_trim = trim(value);
-        size_t vlen = strlen(val_trim);
-        char *final_val = NULL;
-        if (vlen >= 2 && ((val_trim[0] == '"' && val_trim[vlen - 1] == '"') ||
-                          (val_trim[0] == '\'' && val_trim[vlen - 1] == '\''))) {
-            final_val = strndup(val_trim + 1, vlen - 2);
-        } else {
-            final_val = strdup(val_trim);
+        ssize_t r = read(STDIN_FILENO, line + len, want);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            if (len == 0) { free(line); return NULL; }
+            break;   /* last line without newline */
+        }
+        char *nl = memchr(line + len, '\n', (size_t)r);
+        if (nl) {
+            size_t end = (size_t)(nl - line);
+            if (seekable) lseek(STDIN_FILENO, (off_t)end + 1 - (off_t)(len + r), SEEK_CUR);
+            len = end;
+            break;
         }
-        if (!final_val) return -1;
-        // set variable (overwrite if exists)
-        if (set_variable(name, final_val) != 0) {
+        len += (size_t)r;
+    }
+    line[len] = '\0';
+    return line;
+}
+
+/* Next input line (malloc'd, no trailing newline) or NULL at end of input */
+static char *read_line(const char *prompt) {
+    if (cmd_string) {
+        if (*cmd_string == '\0') return NULL;
+        size_t len = strcspn(cmd_string, "\n");
+        char *line = strndup(cmd_string, len);
+        cmd_string += cmd_string[len] ? len + 1 : len;
+        return line;
+    }
+    if (interactive) {
+        if (!readline_ready) init_readline();
+        return readline(prompt);
+    }
+    return read_stdin_line();
+}
+
+#define STMT_ECHO_MAX 80   // longest statement text repeated in parse errors
+
+/* Helper: run one statement given as a token slice (no ';' or '&' inside).
+ * Leading NAME=value words are handled here as builtin assignments; whatever
+ * follows them is parsed and executed as a pipeline.
+ * Returns exit status or -1 on error.
+ */
+static int run_statement(const char *src, const Token *toks, int ntoks, int background) {
+    int i = 0;
+    for (; i < ntoks && toks[i].type == TOK_ASSIGN; ++i) {
+        char *name = toks[i].text;
+        char *eq = strchr(name, '=');
+        *eq = '\0';
+        int rc = set_variable(name, eq + 1);
+        *eq = '=';
+        if (rc != 0) {
             fprintf(stderr, "Failed to set variable\n");
-            free(final_val);
             return -1;
         }
-        free(final_val);
-        return 0;
     }
+    if (i == ntoks) return 0;
 
-    // background detection for single statement (trailing &)
-    int background = 0;
-    size_t L = strlen(s);
-    while (L > 0 && isspace((unsigned char)s[L - 1])) { s[L - 1] = '\0'; L--; }
-    if (L > 0 && s[L - 1] == '&') {
+    // optional 'coproc NAME' prefix: run in the background with pipes to the shell
+    const char *coproc_name = NULL;
+    if (toks[i].type == TOK_WORD && strcmp(toks[i].text, "coproc") == 0) {
+        if (i + 2 >= ntoks || toks[i + 1].type != TOK_WORD || toks[i + 2].type != TOK_WORD) {
+            fprintf(stderr, "coproc: usage: coproc NAME cmd [args]\n");
+            return -1;
+        }
+        coproc_name = toks[i + 1].text;
         background = 1;
-        s[L - 1] = '\0';
-        // trim again trailing spaces
-        while (L > 1 && isspace((unsigned char)s[L - 2])) { s[L - 2] = '\0'; L--; }
+        i += 2;
     }
 
-    // parse pipeline
-    char *copy = strdup(s);
-    if (!copy) return -1;
-    Command cmds[MAX_CMDS];
+    // optional 'limit k=v ...' prefix
+    JobOptions opts;
+    job_options_init(&opts);
+    int used = parse_job_options(toks + i, ntoks - i, &opts);
+    if (used < 0) return -1;
+    i += used;
+
+    const Token *first = &toks[i];
+    const Token *last = &toks[ntoks - 1];
+    Command *cmds = NULL;
     int num_cmds = 0;
     int ret = -1;
-    if (parse_pipeline(copy, cmds, &num_cmds) == 0) {
-        ret = execute_pipeline(cmds, num_cmds, background, s);
-        free_commands(cmds, num_cmds);
+    if (parse_pipeline(first, ntoks - i, &cmds, &num_cmds) == 0) {
+        char *cmdline = strndup(src + first->start, last->end - first->start);
+        if (coproc_name && coproc_prepare(coproc_name, &opts) < 0) {
+            ret = -1;
+        } else {
+            ret = execute_pipeline(cmds, num_cmds, background, cmdline, &opts);
+            if (coproc_name && coproc_commit(coproc_name, &opts, ret == 0) < 0) ret = -1;
+        }
+        free(cmdline);
     } else {
-        fprintf(stderr, "Parse error in statement: %s\n", s);
-        ret = -1;
+        /* the statement may be megabytes long (e.g. an oversized argv) */
+        int len = (int)(last->end - first->start);
+        fprintf(stderr, "Parse error in statement: %.*s%s\n",
+                len > STMT_ECHO_MAX ? STMT_ECHO_MAX : len, src + first->start,
+                len > STMT_ECHO_MAX ? "..." : "");
     }
-    free(copy);
+    free_commands(cmds, num_cmds);
     return ret;
 }
 
-/* Split by ';' and run each statement sequentially */
-static void process_multi_statements(char *line) {
-    char *save = NULL;
-    char *stmt = strtok_r(line, ";", &save);
-    while (stmt != NULL) {
-        char *s = trim(stmt);
-        if (s && s[0] != '\0') {
-            (void) run_statement_return_status(s);
+/* Tokenize a line once and run its statements (separated by ';', '&' or
+ * newline) in order. Returns the status of the last statement, or -1.
+ */
+static int run_line(const char *line) {
+    TokenList tl;
+    if (tokenize(line, &tl) != 0) return -1;
+
+    int ret = 0;
+    int start = 0;
+    for (int i = 0; i <= tl.count; ++i) {
+        if (i < tl.count && tl.toks[i].type != TOK_SEMI && tl.toks[i].type != TOK_AMP) continue;
+        int background = (i < tl.count && tl.toks[i].type == TOK_AMP);
+        if (i > start) {
+            ret = run_statement(line, tl.toks + start, i - start, background);
+        } else if (background) {
+            fprintf(stderr, "Parse error: unexpected '&'\n");
+            ret = -1;
         }
-        stmt = strtok_r(NULL, ";", &save);
+        start = i + 1;
     }
+    free_tokens(&tl);
+    return ret;
 }
 
 /* Collect lines until a keyword (case-insensitive) appears on its own line */
@@ -139,7 +194,7 @@ static char *collect_block_until_keyword(const char *terminator) {
     buf[0] = '\0';
 
     while (1) {
-        char *line = readline("> ");
+        char *line = read_line("> ");
         if (!line) { free(buf); return NULL; } // EOF
         char *t = trim(line);
         if (strcasecmp(t, terminator) == 0) { free(line); break; }
@@ -171,7 +226,7 @@ static int handle_if_block(char *tline) {
     } else {
         char *cline = NULL;
         while (1) {
-            cline = readline("> ");
+            cline = read_line("> ");
             if (!cline) { fprintf(stderr, "Unexpected EOF while reading condition\n"); return -1; }
             char *t = trim(cline);
             if (t && t[0] != '\0') break;
@@ -183,7 +238,7 @@ static int handle_if_block(char *tline) {
     }
 
     while (1) {
-        char *ln = readline("> ");
+        char *ln = read_line("> ");
         if (!ln) { free(condition_cmd); fprintf(stderr, "Unexpected EOF waiting for 'then'\n"); return -1; }
         char *t = trim(ln);
         if (strcasecmp(t, "then") == 0) { free(ln); break; }
@@ -194,7 +249,7 @@ static int handle_if_block(char *tline) {
     int saw_else = 0;
     size_t then_cap = 0, then_len = 0;
     while (1) {
-        char *ln = readline("> ");
+        char *ln = read_line("> ");
         if (!ln) { free(condition_cmd); free(then_block); fprintf(stderr, "Unexpected EOF in then-block\n"); return -1; }
         char *t = trim(ln);
         if (strcasecmp(t, "else") == 0) { saw_else = 1; free(ln); break; }
@@ -220,18 +275,16 @@ static int handle_if_block(char *tline) {
         if (!else_block) { free(condition_cmd); free(then_block); return -1; }
     }
 
-    int cond_status = run_statement_return_status(condition_cmd);
+    int cond_status = run_line(condition_cmd);
     free(condition_cmd);
 
     if (cond_status == 0) {
         if (then_block && then_block[0] != '\0') {
-            char *tmp = strdup(then_block);
-            if (tmp) { process_multi_statements(tmp); free(tmp); }
+            (void) run_line(then_block);
         }
     } else {
         if (else_block && else_block[0] != '\0') {
-            char *tmp = strdup(else_block);
-            if (tmp) { process_multi_statements(tmp); free(tmp); }
+            (void) run_line(else_block);
         }
     }
 
@@ -240,20 +293,20 @@ static int handle_if_block(char *tline) {
     return 0;
 }
 
-int main(void) {
-    rl_attempted_completion_function = my_completion;
-    using_history();
-
+/* Read-eval loop over the current input source. Returns the status of the
+ * last command (-1 on error). */
+static int run_input(void) {
     char *line = NULL;
+    int status = 0;
     while (1) {
         reap_jobs();
-        line = readline(PROMPT);
+        line = read_line(PROMPT);
         if (!line) break; // EOF (Ctrl+D)
 
         char *tline = trim(line);
         if (!tline || tline[0] == '\0') { free(line); continue; }
 
-        add_history(line);
+        if (interactive) add_history(line);
 
         // Handle !n re-execution
         if (line[0] == '!') {
@@ -273,26 +326,53 @@ int main(void) {
         }
 
         // Detect 'if' blocks
-        char *copy = strdup(tline);
-        if (!copy) { free(line); break; }
-        char *first = strtok(copy, " \t");
-        if (first && strcmp(first, "if") == 0) {
-            handle_if_block(tline);
-            free(copy);
+        if (strncmp(tline, "if", 2) == 0 && (tline[2] == '\0' || isspace((unsigned char)tline[2]))) {
+            status = handle_if_block(tline);
             free(line);
             continue;
         }
-        free(copy);
 
         // Otherwise treat input as possibly multiple statements separated by ';'
-        char *work = strdup(tline);
-        if (!work) { free(line); break; }
-        process_multi_statements(work);
-        free(work);
+        status = run_line(tline);
         free(line);
     }
+    return status;
+}
+
+/* Run a whole script non-interactively (used by -c and server workers). */
+int run_script_string(const char *script) {
+    interactive = 0;
+    cmd_string = script;
+    int status = run_input();
+    cmd_string = NULL;
+    return status < 0 ? 1 : status;
+}
 
+int main(int argc, char **argv) {
+    const char *init = NULL, *server_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) init = argv[++i];
+        else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) server_path = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [-c command] [--server socket]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // --server: -c (if given) prepares the base environment every request starts from
+    if (server_path) {
+        if (init) run_script_string(init);
+        return run_server(server_path);
+    }
+    if (init) {
+        int status = run_script_string(init);
+        free_all_variables();
+        return status;
+    }
+
+    interactive = isatty(STDIN_FILENO);
+    int status = run_input();
     free_all_variables();
-    printf("\nShell exited.\n");
-    return 0;
+    if (interactive) printf("\nShell exited.\n");
+    return status < 0 ? 1 : status;
 }
@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+#include "shell.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+/* ----------------- Pipeline placement -----------------
+ * CPU affinity and priority for the stages of a job, set through the
+ * 'limit' prefix:
+ *   cpuset=LIST     restrict every stage to LIST (e.g. 0-3,8)
+ *   pin=pack        stage i gets its own CPU; adjacent stages land on SMT
+ *                   siblings / cores sharing an L3 (cache locality)
+ *   pin=spread      stage i gets its own CPU, spaced as far apart as possible
+ *   nice=N          setpriority() for every stage
+ *   ioprio=CLASS[:LEVEL]  idle, be:0-7 or rt:0-7
+ */
+
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+/* CPU ids in topology order: package, L3 domain, core, then SMT thread.
+ * Computed once; filtered by the job's mask in placement_order(). */
+typedef struct {
+    int cpu;
+    int package;
+    int llc;
+    int core;
+} CpuTopo;
+
+static CpuTopo *topo = NULL;
+static int topo_count = -1;
+
+static int read_int_file(const char *fmt, int cpu) {
+    char path[128], buf[32];
+    snprintf(path, sizeof(path), fmt, cpu);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t r = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (r <= 0) return -1;
+    buf[r] = '\0';
+    return atoi(buf);
+}
+
+static int topo_cmp(const void *a, const void *b) {
+    const CpuTopo *x = a, *y = b;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->llc != y->llc) return x->llc - y->llc;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+static void load_topology(void) {
+    if (topo_count >= 0) return;
+    topo_count = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+    if (ncpu <= 0) return;
+    topo = calloc(ncpu, sizeof(CpuTopo));
+    if (!topo) return;
+    for (int c = 0; c < ncpu; ++c) {
+        CpuTopo *t = &topo[topo_count++];
+        t->cpu = c;
+        t->package = read_int_file("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+        t->llc = read_int_file("/sys/devices/system/cpu/cpu%d/cache/index3/id", c);
+        t->core = read_int_file("/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+        if (t->core < 0) t->core = c;
+    }
+    qsort(topo, topo_count, sizeof(CpuTopo), topo_cmp);
+}
+
+/* ----------------- Option parsing ----------------- */
+/* "0-3,8,10-11" -> mask. Returns 0 on success, -1 on error. */
+int parse_cpu_list(const char *s, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = s;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p || lo < 0) return -1;
+        p = end;
+        if (*p == '-') {
+            hi = strtol(p + 1, &end, 10);
+            if (end == p + 1 || hi < lo) return -1;
+            p = end;
+        }
+        if (hi >= CPU_SETSIZE) return -1;
+        for (long c = lo; c <= hi; ++c) CPU_SET(c, set);
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+/* "idle", "be", "be:4", "rt:0" -> ioprio value. Returns -1 on error. */
+int parse_ioprio(const char *s) {
+    int cls, level = 4;
+    if (strncmp(s, "idle", 4) == 0) { cls = 3; level = 0; s += 4; }
+    else if (strncmp(s, "be", 2) == 0) { cls = 2; s += 2; }
+    else if (strncmp(s, "rt", 2) == 0) { cls = 1; s += 2; }
+    else return -1;
+    if (*s == ':' && cls != 3) {
+        char *end;
+        level = (int)strtol(s + 1, &end, 10);
+        if (end == s + 1 || *end != '\0' || level < 0 || level > 7) return -1;
+    } else if (*s != '\0') {
+        return -1;
+    }
+    return (cls << IOPRIO_CLASS_SHIFT) | level;
+}
+
+/* ----------------- Stage -> CPU mapping ----------------- */
+/* CPUs allowed for this job, in topology order. Returns a malloc'd array
+ * (*n entries) or NULL when the job has no per-stage pinning.
+ */
+int *placement_order(const JobOptions *o, int *n) {
+    *n = 0;
+    if (!o || !o->active || o->pin == PIN_NONE) return NULL;
+
+    cpu_set_t mask;
+    if (o->has_cpuset) mask = o->cpuset;
+    else if (sched_getaffinity(0, sizeof(mask), &mask) < 0) return NULL;
+
+    load_topology();
+    int *order = malloc((topo_count > 0 ? topo_count : 1) * sizeof(int));
+    if (!order) return NULL;
+    for (int i = 0; i < topo_count; ++i)
+        if (CPU_ISSET(topo[i].cpu, &mask)) order[(*n)++] = topo[i].cpu;
+    if (*n == 0) { free(order); return NULL; }
+    return order;
+}
+
+/* CPU for stage 'stage' of 'nstages' */
+int placement_cpu(const JobOptions *o, const int *order, int n, int stage, int nstages) {
+    if (!order || n <= 0) return -1;
+    if (o->pin == PIN_SPREAD && nstages > 1 && nstages < n)
+        return order[(long)stage * (n - 1) / (nstages - 1)];
+    return order[stage % n];
+}
+
+/* ----------------- Applying placement (in the child) ----------------- */
+void job_apply_placement(const JobOptions *o, int cpu) {
+    if (!o || !o->active) return;
+
+    cpu_set_t mask;
+    int set_mask = 0;
+    if (cpu >= 0) {
+        CPU_ZERO(&mask);
+        CPU_SET(cpu, &mask);
+        set_mask = 1;
+    } else if (o->has_cpuset) {
+        mask = o->cpuset;
+        set_mask = 1;
+    }
+    if (set_mask && sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+        perror("limit: sched_setaffinity");
+        exit(1);
+    }
+    if (o->has_nice && setpriority(PRIO_PROCESS, 0, o->nice) < 0) {
+        perror("limit: setpriority");
+        exit(1);
+    }
+    if (o->ioprio >= 0 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, o->ioprio) < 0) {
+        perror("limit: ioprio_set");
+        exit(1);
+    }
+}
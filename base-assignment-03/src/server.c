@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+#include "shell.h"
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/* ----------------- Server mode -----------------
+ * 'myshell --server SOCK' keeps one warm shell listening on a unix socket.
+ * Every connection is served by a forked worker, so requests run
+ * concurrently and each one starts from a copy-on-write clone of the
+ * server's variables: changes made by a script never leak into the base
+ * environment or into other requests.
+ *
+ * The socket is created mode 0600 and connections from other uids are
+ * refused: a request runs arbitrary commands as the server's user.
+ */
+
+static int reply_fd = -1;
+static int reply_sent = 0;
+static pid_t worker_pid = 0;
+
+/* accept loop bookkeeping: live workers, so that background jobs of the
+ * -c init script (also our children) are not counted as workers */
+static pid_t workers[SERVER_MAX_WORKERS];
+static int nworkers = 0;
+
+static void child_done(pid_t pid) {
+    for (int i = 0; i < nworkers; ++i) {
+        if (workers[i] == pid) {
+            workers[i] = workers[--nworkers];
+            return;
+        }
+    }
+    remove_job_by_pid(pid);
+}
+
+/* SIGCHLD is blocked except inside ppoll(), so a child that exits at any
+ * point wakes the accept loop and is reaped right away instead of lingering
+ * as a zombie until the next request. */
+static void on_sigchld(int sig) {
+    (void)sig;
+}
+
+static int peer_is_owner(int cfd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(cfd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) return 0;
+    return cred.uid == getuid();
+}
+
+static void send_status(int status) {
+    if (reply_fd < 0 || reply_sent) return;
+    int st = status;
+    ssize_t w;
+    do { w = write(reply_fd, &st, sizeof(st)); } while (w < 0 && errno == EINTR);
+    reply_sent = 1;
+}
+
+/* 'exit' inside a request script ends the worker through exit(). Pipeline
+ * children that fail to exec also exit() and inherit this handler. */
+static void send_status_at_exit(void) {
+    if (getpid() != worker_pid) return;
+    fflush(stdout);
+    fflush(stderr);
+    send_status(0);
+}
+
+static int read_full(int fd, void *buf, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t r = read(fd, (char *)buf + off, len - off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        off += (size_t)r;
+    }
+    return 0;
+}
+
+/* Receive the header and its 3 fds. Returns 0 on success, -1 on error. */
+static int recv_request(int cfd, ServerRequest *req, int fds[3]) {
+    char cbuf[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = { .iov_base = req, .iov_len = sizeof(*req) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    ssize_t r;
+    do { r = recvmsg(cfd, &msg, MSG_CMSG_CLOEXEC); } while (r < 0 && errno == EINTR);
+    if (r <= 0) return -1;
+
+    int got = 0;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        int n = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        int *in = (int *)CMSG_DATA(c);
+        for (int i = 0; i < n; ++i) {
+            if (got < 3) fds[got++] = in[i];
+            else close(in[i]);
+        }
+    }
+    if (got != 3 || (msg.msg_flags & MSG_CTRUNC)) goto bad;
+    /* the rest of a short header read carries no fds */
+    if ((size_t)r < sizeof(*req) && read_full(cfd, (char *)req + r, sizeof(*req) - r) < 0) goto bad;
+    if (req->magic != SERVER_MAGIC || req->script_len > SERVER_MAX_SCRIPT) goto bad;
+    return 0;
+
+bad:
+    for (int i = 0; i < got; ++i) close(fds[i]);
+    return -1;
+}
+
+/* Return fd itself, or a close-on-exec copy >= 3 if it is 0-2 (the old
+ * number is closed). -1 on error. */
+static int fd_above_stdio(int fd) {
+    if (fd > 2) return fd;
+    int nfd = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+    if (nfd < 0) { perror("server: fcntl"); return -1; }
+    close(fd);
+    return nfd;
+}
+
+/* Worker: runs in the forked child, never returns to the accept loop. */
+static int serve_request(int cfd) {
+    ServerRequest req;
+    int fds[3];
+    if (recv_request(cfd, &req, fds) < 0) {
+        fprintf(stderr, "server: bad request\n");
+        return 1;
+    }
+    char *script = malloc(req.script_len + 1);
+    if (!script || read_full(cfd, script, req.script_len) < 0) {
+        fprintf(stderr, "server: short script\n");
+        return 1;
+    }
+    script[req.script_len] = '\0';
+
+    /* a server started with closed stdio gets fds 0-2 for the connection
+     * and the received fds: move them out of the way before dup2() */
+    if ((cfd = fd_above_stdio(cfd)) < 0) return 1;
+    for (int i = 0; i < 3; ++i)
+        if ((fds[i] = fd_above_stdio(fds[i])) < 0) return 1;
+    for (int i = 0; i < 3; ++i) {
+        if (dup2(fds[i], i) < 0) { perror("server: dup2"); return 1; }
+        close(fds[i]);
+    }
+
+    reply_fd = cfd;
+    worker_pid = getpid();
+    atexit(send_status_at_exit);
+    int status = run_script_string(script);
+    fflush(stdout);
+    fflush(stderr);
+    send_status(status);
+    return status;
+}
+
+int run_server(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "server: socket path too long\n");
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* replace a stale socket, but never some other file */
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "server: %s exists and is not a socket\n", path);
+            return 1;
+        }
+        unlink(path);
+    }
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (lfd < 0) { perror("server: socket"); return 1; }
+    mode_t old_mask = umask(077);   /* socket file is created 0600 */
+    int rc = bind(lfd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc < 0) { perror("server: bind"); close(lfd); return 1; }
+    if (listen(lfd, 128) < 0) { perror("server: listen"); close(lfd); return 1; }
+
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa = { 0 };
+    sa.sa_handler = on_sigchld;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+    sigset_t chld, orig_mask, wait_mask;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &orig_mask);
+    wait_mask = orig_mask;
+    sigdelset(&wait_mask, SIGCHLD);
+    fprintf(stderr, "server: listening on %s\n", path);
+    fflush(stdout);
+
+    for (;;) {
+        pid_t done;
+        while ((done = waitpid(-1, NULL, WNOHANG)) > 0) child_done(done);
+        if (nworkers >= SERVER_MAX_WORKERS) {
+            if ((done = waitpid(-1, NULL, 0)) > 0) child_done(done);
+            continue;
+        }
+
+        struct pollfd pfd = { .fd = lfd, .events = POLLIN };
+        if (ppoll(&pfd, 1, NULL, &wait_mask) < 0) {
+            if (errno != EINTR) perror("server: ppoll");
+            continue;
+        }
+        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) perror("server: accept");
+            continue;
+        }
+        if (!peer_is_owner(cfd)) {
+            fprintf(stderr, "server: refused connection from another user\n");
+            close(cfd);
+            continue;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            /* the worker waits for its own pipelines normally */
+            signal(SIGCHLD, SIG_DFL);
+            sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+            close(lfd);
+            exit(serve_request(cfd));
+        }
+        if (pid < 0) perror("server: fork");
+        else workers[nworkers++] = pid;
+        close(cfd);
+    }
+}
@@ -1,5 +1,6 @@
 #define _GNU_SOURCE
 #include "shell.h"
+#include <signal.h>
 
 /* ----------------- Utility: trim ----------------- */
 char *trim(char *s) {
@@ -11,68 +12,124 @@ char *trim(char *s) {
     return s;
 }
 
+static char *expand_token(const char *token);
+
+/* Longest single argv/envp string execve() accepts (Linux MAX_ARG_STRLEN,
+ * 32 pages), terminating NUL included. */
+#define ARG_STRLEN_MAX (32 * 4096)
+
+extern char **environ;
+
+/* ARG_MAX minus what the environment already uses. Neither changes while
+ * we run (the shell never exports variables), so compute it only once. */
+static long get_arg_max(void) {
+    static long arg_max = 0;
+    if (arg_max == 0) {
+        arg_max = sysconf(_SC_ARG_MAX);
+        if (arg_max <= 0) arg_max = 131072;
+        for (char **e = environ; e && *e; ++e) arg_max -= strlen(*e) + 1 + sizeof(char *);
+    }
+    return arg_max;
+}
+
 /* ----------------- Parsing: parse_pipeline -----------------
- * Splits by '|' and builds Command[] with argv[], input_file, output_file.
- * Caller must pass a writable string (we use strdup in caller).
+ * Builds Command[] with argv[], input_file, output_file from the tokens of a
+ * single statement (see tokenize()). The stage array and every argv are
+ * allocated once, sized from the token counts, so there is no fixed limit
+ * other than what execve() accepts (ARG_MAX with the environment, and
+ * ARG_STRLEN_MAX per argument). Words are copied, so the TokenList may be freed
+ * afterwards.
  * Returns 0 on success, -1 on parse error.
  */
-int parse_pipeline(char *line, Command *cmds, int *num_cmds) {
-    if (!line || !cmds || !num_cmds) return -1;
+int parse_pipeline(const Token *toks, int ntoks, Command **out, int *num_cmds) {
+    if (!toks || !out || !num_cmds) return -1;
+    *out = NULL;
     *num_cmds = 0;
-
-    char *save_seg = NULL;
-    char *segment = strtok_r(line, "|", &save_seg);
-    while (segment != NULL) {
-        if (*num_cmds >= MAX_CMDS) {
-            fprintf(stderr, "Error: too many commands in pipeline (max %d)\n", MAX_CMDS);
-            return -1;
-        }
-        Command *cmd = &cmds[*num_cmds];
-        for (int i = 0; i < MAX_ARGS; ++i) cmd->argv[i] = NULL;
-        cmd->input_file = NULL;
-        cmd->output_file = NULL;
-
-        char *seg = trim(segment);
-        if (seg[0] == '\0') { fprintf(stderr, "Parse error: empty command in pipeline\n"); return -1; }
-
-        char *save_tok = NULL;
-        char *tok = strtok_r(seg, " \t\r\n", &save_tok);
-        int ai = 0;
-        while (tok != NULL) {
-            if (strcmp(tok, "<") == 0) {
-                tok = strtok_r(NULL, " \t\r\n", &save_tok);
-                if (!tok) { fprintf(stderr, "Parse error: expected filename after '<'\n"); return -1; }
-                cmd->input_file = strdup(tok);
-            } else if (strcmp(tok, ">") == 0) {
-                tok = strtok_r(NULL, " \t\r\n", &save_tok);
-                if (!tok) { fprintf(stderr, "Parse error: expected filename after '>'\n"); return -1; }
-                cmd->output_file = strdup(tok);
+    if (ntoks <= 0) return -1;
+
+    int nstages = 1;
+    for (int i = 0; i < ntoks; ++i)
+        if (toks[i].type == TOK_PIPE) nstages++;
+
+    Command *cmds = calloc(nstages, sizeof(Command));
+    if (!cmds) { perror("calloc"); return -1; }
+    *out = cmds;
+
+    long arg_max = get_arg_max();
+
+    int ti = 0;
+    for (int s = 0; s < nstages; ++s) {
+        Command *cmd = &cmds[s];
+        *num_cmds = s + 1;
+
+        int end = ti, words = 0;
+        for (; end < ntoks && toks[end].type != TOK_PIPE; ++end)
+            if (toks[end].type == TOK_WORD || toks[end].type == TOK_ASSIGN) words++;
+
+        cmd->argv = malloc((words + 1) * sizeof(char *));
+        if (!cmd->argv) { perror("malloc"); return -1; }
+        cmd->argv[0] = NULL;
+
+        size_t bytes = 0;
+        for (; ti < end; ++ti) {
+            const Token *t = &toks[ti];
+            if (t->type == TOK_REDIR_IN || t->type == TOK_REDIR_OUT) {
+                const char *op = t->type == TOK_REDIR_IN ? "<" : ">";
+                if (ti + 1 >= end || (toks[ti + 1].type != TOK_WORD && toks[ti + 1].type != TOK_ASSIGN)) {
+                    fprintf(stderr, "Parse error: expected filename after '%s'\n", op);
+                    return -1;
+                }
+                char **dst = t->type == TOK_REDIR_IN ? &cmd->input_file : &cmd->output_file;
+                free(*dst);
+                *dst = strdup(toks[++ti].text);
+            } else if (t->type == TOK_WORD || t->type == TOK_ASSIGN) {
+                char *arg;
+                if (t->text[0] == '$' && !(t->flags & TOKF_NOEXPAND))
+                    arg = expand_token(t->text);
+                else
+                    arg = strdup(t->text);
+                if (!arg) { perror("strdup"); return -1; }
+                cmd->argv[cmd->argc++] = arg;
+                cmd->argv[cmd->argc] = NULL;
+                size_t len = strlen(arg) + 1;
+                if (len > ARG_STRLEN_MAX) {
+                    fprintf(stderr, "Error: argument too long (%zu bytes, limit %d)\n", len, ARG_STRLEN_MAX);
+                    return -1;
+                }
+                bytes += len + sizeof(char *);
             } else {
-                if (ai >= MAX_ARGS - 1) { fprintf(stderr, "Error: too many arguments\n"); return -1; }
-                cmd->argv[ai++] = strdup(tok);
+                fprintf(stderr, "Parse error: unexpected operator\n");
+                return -1;
             }
-            tok = strtok_r(NULL, " \t\r\n", &save_tok);
         }
-        cmd->argv[ai] = NULL;
 
-        if (cmd->argv[0] == NULL) { fprintf(stderr, "Parse error: empty command\n"); return -1; }
-
-        (*num_cmds)++;
-        segment = strtok_r(NULL, "|", &save_seg);
+        if (bytes > (size_t)arg_max) {
+            fprintf(stderr, "Error: argument list too long (%zu bytes, %ld left after the environment)\n",
+                    bytes, arg_max);
+            return -1;
+        }
+        if (cmd->argc == 0) {
+            fprintf(stderr, nstages > 1 ? "Parse error: empty command in pipeline\n"
+                                        : "Parse error: empty command\n");
+            return -1;
+        }
+        ti = end + 1;   /* skip '|' */
     }
     return 0;
 }
 
 /* ----------------- Free memory inside commands ----------------- */
 void free_commands(Command *cmds, int num_cmds) {
+    if (!cmds) return;
     for (int i = 0; i < num_cmds; ++i) {
-        for (int j = 0; j < MAX_ARGS && cmds[i].argv[j] != NULL; ++j) {
-            free(cmds[i].argv[j]);
-            cmds[i].argv[j] = NULL;
+        if (cmds[i].argv) {
+            for (int j = 0; j < cmds[i].argc; ++j) free(cmds[i].argv[j]);
+            free(cmds[i].argv);
         }
-        if (cmds[i].input_file) { free(cmds[i].input_file); cmds[i].input_file = NULL; }
-        if (cmds[i].output_file) { free(cmds[i].output_file); cmds[i].output_file = NULL; }
+        free(cmds[i].input_file);
+        free(cmds[i].output_file);
     }
+    free(cmds);
 }
 
 /* ----------------- Variables handling ----------------- */
@@ -107,6 +164,20 @@ int set_variable(const char *name, const char *value) {
     return 0;
 }
 
+int unset_variable(const char *name) {
+    for (VarNode **pp = &vars_head; *pp; pp = &(*pp)->next) {
+        if (strcmp((*pp)->name, name) == 0) {
+            VarNode *n = *pp;
+            *pp = n->next;
+            free(n->name);
+            free(n->value);
+            free(n);
+            return 0;
+        }
+    }
+    return -1;
+}
+
 const char *get_variable(const char *name) {
     VarNode *n = find_var(name);
     if (!n) return NULL;
@@ -165,23 +236,15 @@ static char *expand_token(const char *token) {
     return strdup(val ? val : "");
 }
 
-/* Expand variables in all cmds/argv in-place: free old argv strings and replace with expanded ones.
- * Returns 0 on success, -1 on error.
- */
-int expand_vars_in_commands(Command *cmds, int num_cmds) {
-    for (int i = 0; i < num_cmds; ++i) {
-        for (int j = 0; j < MAX_ARGS && cmds[i].argv[j] != NULL; ++j) {
-            char *orig = cmds[i].argv[j];
-            if (orig[0] == '$') {
-                char *expanded = expand_token(orig);
-                if (!expanded) return -1;
-                free(orig);
-                cmds[i].argv[j] = expanded;
-            } else {
-                /* no change */
-            }
-        }
-    }
+/* Names handled by handle_builtin_status() (including the coproc builtins) */
+static const char *builtin_names[] = {
+    "exit", "cd", "help", "jobs", "history", "set", "true", "false", ":",
+    "coproc_send", "coproc_recv", "coproc_close", NULL
+};
+
+int is_builtin(const char *name) {
+    for (int i = 0; name && builtin_names[i]; ++i)
+        if (strcmp(name, builtin_names[i]) == 0) return 1;
     return 0;
 }
 
@@ -210,13 +273,20 @@ int handle_builtin_status(char **arglist, int *status) {
                " exit - exit shell\n"
                " cd <dir> - change directory\n"
                " help - display this message\n"
-               " jobs - list background jobs\n"
+               " jobs [-v] - list background jobs (-v: cgroup memory/cpu usage)\n"
+               " limit k=v ... cmd - run cmd with cpu=SEC as=SIZE files=N mem=SIZE cpus=N\n"
+               "                     cpuset=LIST pin=pack|spread nice=N ioprio=idle|be:N|rt:N\n"
                " history - show command history\n"
-               " set - list variables\n"); // <-- UPDATED: added 'set'
+               " set - list variables\n" // <-- UPDATED: added 'set'
+               " true, false, : - return 0 / 1 / 0\n"
+               " coproc NAME cmd - start a persistent worker (sets NAME_PID, NAME_IN, NAME_OUT)\n"
+               " coproc_send NAME words - write a line to the worker\n"
+               " coproc_recv NAME [VAR] - read a reply line into VAR or print it\n"
+               " coproc_close NAME - close the worker's pipes\n");
         *status = 0;
         return 1;
     } else if (strcmp(arglist[0], "jobs") == 0) {
-        print_jobs();
+        print_jobs(arglist[1] && strcmp(arglist[1], "-v") == 0);
         *status = 0;
         return 1;
     } else if (strcmp(arglist[0], "history") == 0) {
@@ -230,38 +300,56 @@ int handle_builtin_status(char **arglist, int *status) {
         print_variables();
         *status = 0;
         return 1;
+    } else if (strcmp(arglist[0], "true") == 0 || strcmp(arglist[0], ":") == 0) {
+        *status = 0;
+        return 1;
+    } else if (strcmp(arglist[0], "false") == 0) {
+        *status = 1;
+        return 1;
     }
-    return 0;
+    return handle_coproc_builtin(arglist, status);
 }
 
 /* ----------------- Job management ----------------- */
 static Job jobs[MAX_JOBS];
 static int jobs_count = 0;
 
-int add_job(pid_t pid, const char *cmdline) {
+int add_job(pid_t pid, const char *cmdline, const char *cgroup, int limited) {
     if (jobs_count >= MAX_JOBS) return -1;
     jobs[jobs_count].pid = pid;
     jobs[jobs_count].cmdline = cmdline ? strdup(cmdline) : strdup("(bg)");
+    jobs[jobs_count].cgroup = cgroup ? strdup(cgroup) : NULL;
+    jobs[jobs_count].leader_done = 0;
+    jobs[jobs_count].limited = limited;
     jobs_count++;
     return 0;
 }
 
+static void drop_job(int i) {
+    free(jobs[i].cmdline);
+    free(jobs[i].cgroup);
+    for (int j = i; j < jobs_count - 1; ++j) jobs[j] = jobs[j + 1];
+    jobs_count--;
+}
+
+/* A job with a cgroup stays listed until its cgroup is empty (other
+ * pipeline stages may outlive the first one). */
 int remove_job_by_pid(pid_t pid) {
     for (int i = 0; i < jobs_count; ++i) {
-        if (jobs[i].pid == pid) {
-            free(jobs[i].cmdline);
-            for (int j = i; j < jobs_count - 1; ++j) jobs[j] = jobs[j + 1];
-            jobs_count--;
+        if (jobs[i].pid == pid && !jobs[i].leader_done) {
+            if (job_cgroup_remove(jobs[i].cgroup) < 0) jobs[i].leader_done = 1;
+            else drop_job(i);
             return 0;
         }
     }
     return -1;
 }
 
-void print_jobs(void) {
+void print_jobs(int verbose) {
     if (jobs_count == 0) { printf("No background jobs.\n"); return; }
     for (int i = 0; i < jobs_count; ++i) {
         printf("[%d] PID=%d  %s\n", i + 1, jobs[i].pid, jobs[i].cmdline);
+        if (verbose) print_job_usage(jobs[i].cgroup, jobs[i].limited);
     }
 }
 
@@ -272,51 +360,95 @@ void reap_jobs(void) {
     while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
         remove_job_by_pid(pid);
     }
+    for (int i = jobs_count - 1; i >= 0; --i) {
+        if (jobs[i].leader_done && job_cgroup_remove(jobs[i].cgroup) == 0) drop_job(i);
+    }
 }
 
 /* ----------------- Execution: pipelines & redirection ------------- */
-int execute_pipeline(Command *cmds, int num_cmds, int background, const char *orig_cmdline) {
+int execute_pipeline(Command *cmds, int num_cmds, int background, const char *orig_cmdline,
+                     const JobOptions *opts) {
     if (num_cmds <= 0) return -1;
 
-    if (expand_vars_in_commands(cmds, num_cmds) != 0) {
-        fprintf(stderr, "Variable expansion error\n");
-        return -1;
-    }
-
+    int limited = opts && opts->active;
     if (num_cmds == 1 && !background) {
+        if (limited && is_builtin(cmds[0].argv[0])) {
+            fprintf(stderr, "limit: %s is a builtin; limits cannot be applied\n", cmds[0].argv[0]);
+            return -1;
+        }
         int bstatus = 0;
         if (handle_builtin_status(cmds[0].argv, &bstatus)) {
             return bstatus & 0xFF;
         }
     }
+    /* reserve the job slot before creating anything a job would own */
+    if (background && jobs_count >= MAX_JOBS) {
+        fprintf(stderr, "Error: job list full (%d jobs)\n", MAX_JOBS);
+        return -1;
+    }
+
+    fflush(stdout);   /* don't let children inherit (and re-flush) buffered output */
 
+    /* Pipes are created one stage at a time, so the parent holds at most
+     * one pipe at once no matter how long the pipeline is. */
     int n = num_cmds;
-    int pipefds[2 * (n - 1)];
-    pid_t pids[n];
+    pid_t *pids = malloc(n * sizeof(pid_t));
+    if (!pids) { perror("malloc"); return -1; }
+    int prev_read = -1;
+
+    char *cgroup = NULL;
+    if (limited) {
+        cgroup = job_cgroup_create(opts);
+        if (!cgroup && opts->cpus > 0)
+            fprintf(stderr, "limit: cgroup v2 not available; cpus= ignored\n");
+    }
+    int ncpu = 0;
+    int *cpu_order = placement_order(opts, &ncpu);
 
-    for (int i = 0; i < n - 1; ++i) {
-        if (pipe(pipefds + 2 * i) < 0) {
+    for (int i = 0; i < n; ++i) {
+        int pfd[2] = { -1, -1 };
+        if (i < n - 1 && pipe(pfd) < 0) {
             perror("pipe");
-            for (int k = 0; k < 2 * i; ++k) close(pipefds[k]);
+            if (prev_read >= 0) close(prev_read);
+            for (int k = 0; k < i; ++k) waitpid(pids[k], NULL, 0);
+            job_cgroup_remove(cgroup);
+            free(cgroup);
+            free(cpu_order);
+            free(pids);
             return -1;
         }
-    }
-
-    for (int i = 0; i < n; ++i) {
         pid_t pid = fork();
         if (pid < 0) {
             perror("fork");
-            for (int k = 0; k < 2 * (n - 1); ++k) close(pipefds[k]);
+            if (prev_read >= 0) close(prev_read);
+            if (pfd[0] >= 0) { close(pfd[0]); close(pfd[1]); }
+            for (int k = 0; k < i; ++k) waitpid(pids[k], NULL, 0);
+            job_cgroup_remove(cgroup);
+            free(cgroup);
+            free(cpu_order);
+            free(pids);
             return -1;
         }
         if (pid == 0) {
-            if (i > 0) {
-                if (dup2(pipefds[(i - 1) * 2], STDIN_FILENO) < 0) { perror("dup2 stdin"); exit(1); }
+            signal(SIGPIPE, SIG_DFL);   /* the shell ignores it once coprocs exist */
+            job_apply_limits(opts, cgroup);
+            job_apply_placement(opts, placement_cpu(opts, cpu_order, ncpu, i, n));
+            if (prev_read >= 0) {
+                if (dup2(prev_read, STDIN_FILENO) < 0) { perror("dup2 stdin"); exit(1); }
+                close(prev_read);
+            }
+            if (pfd[1] >= 0) {
+                if (dup2(pfd[1], STDOUT_FILENO) < 0) { perror("dup2 stdout"); exit(1); }
+                close(pfd[0]);
+                close(pfd[1]);
+            }
+
+            if (i == 0 && opts && opts->stdin_fd >= 0 && dup2(opts->stdin_fd, STDIN_FILENO) < 0) {
+                perror("dup2 coproc stdin"); exit(1);
             }
-            if (i < n - 1) {
-                if (dup2(pipefds[i * 2 + 1], STDOUT_FILENO) < 0) { perror("dup2 stdout"); exit(1); }
+            if (i == n - 1 && opts && opts->stdout_fd >= 0 && dup2(opts->stdout_fd, STDOUT_FILENO) < 0) {
+                perror("dup2 coproc stdout"); exit(1);
             }
-            for (int k = 0; k < 2 * (n - 1); ++k) close(pipefds[k]);
 
             if (cmds[i].input_file) {
                 int fd = open(cmds[i].input_file, O_RDONLY);
@@ -336,17 +468,21 @@ int execute_pipeline(Command *cmds, int num_cmds, int background, const char *or
             exit(1);
         } else {
             pids[i] = pid;
+            if (prev_read >= 0) close(prev_read);
+            if (pfd[1] >= 0) close(pfd[1]);
+            prev_read = pfd[0];
         }
     }
 
-    for (int k = 0; k < 2 * (n - 1); ++k) close(pipefds[k]);
-
     if (background) {
-        if (add_job(pids[0], orig_cmdline) < 0) {
-            fprintf(stderr, "Warning: job list full; cannot track background job\n");
-        } else {
-            printf("[bg] started PID %d\n", pids[0]);
-        }
+        char pidbuf[16];
+        snprintf(pidbuf, sizeof(pidbuf), "%d", pids[0]);
+        set_variable("!", pidbuf);
+        add_job(pids[0], orig_cmdline, cgroup, limited);   /* slot reserved above */
+        printf("[bg] started PID %d\n", pids[0]);
+        free(cgroup);
+        free(cpu_order);
+        free(pids);
         return 0;
     } else {
         int last_status = 0;
@@ -357,6 +493,19 @@ int execute_pipeline(Command *cmds, int num_cmds, int background, const char *or
                 last_status = status;
             }
         }
+        /* stages exited but their descendants still run in the cgroup:
+         * list it as a job so reap_jobs() removes it once it empties */
+        if (job_cgroup_remove(cgroup) < 0) {
+            if (add_job(pids[0], orig_cmdline, cgroup, limited) == 0) {
+                jobs[jobs_count - 1].leader_done = 1;
+                fprintf(stderr, "limit: processes still running in %s; listed under 'jobs'\n", cgroup);
+            } else {
+                fprintf(stderr, "limit: %s still populated; remove it by hand\n", cgroup);
+            }
+        }
+        free(cgroup);
+        free(cpu_order);
+        free(pids);
         if (WIFEXITED(last_status)) return WEXITSTATUS(last_status);
         if (WIFSIGNALED(last_status)) return 128 + WTERMSIG(last_status);
         return last_status & 0xFF;